@@ -0,0 +1,522 @@
+// Benchmark of BVH builders, bounding volumes and prune strategies.
+//
+// Sweeps every PLY file in ./ply_inputs across the partitioning functions in dcel_BVH.H and the binned SAH builder (with one and
+// eight primitives per leaf), AABBT and BoundingSphereT, and all prune functions. Each tree is also queried after flattening, through
+// triangle packets, and through a snapshot, and one record per configuration is written as JSON (default) or CSV.
+//
+// For each mesh it also checks dcel::NarrowBandSDFT against the exact distance at random points in the narrow band, and exits with a
+// non-zero status if the interpolation error exceeds the error bound.
+//
+// Usage: ./benchmark.ex [--queries N] [--format json|csv] [--output file] [--mesh name]
+//
+//   --queries N   Number of random query points per mesh (default 2000)
+//   --format      Output format (default json)
+//   --output      Output file (default stdout)
+//   --mesh name   Only run meshes whose file name contains name
+
+#include "dcel_vertex.H"
+#include "dcel_edge.H"
+#include "dcel_face.H"
+#include "dcel_mesh.H"
+#include "dcel_parser.H"
+#include "dcel_BVH.H"
+#include "dcel_packet.H"
+#include "dcel_snapshot.H"
+#include "dcel_sdf.H"
+#include "BoundingVolumes.H"
+#include "BVH.H"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include <dirent.h>
+
+// Specifies precision for BVH/DCEL magic.
+using T    = float;
+using face = dcel::faceT<T>;
+using mesh = dcel::meshT<T>;
+using Vec3 = Vec3T<T>;
+
+using Clock = std::chrono::steady_clock;
+
+// Cost of traversing a node and of intersecting a primitive in the SAH cost.
+constexpr T traversalCost    = 1.0;
+constexpr T intersectionCost = 1.0;
+
+// One benchmark record.
+struct Record {
+  std::string mesh;
+  std::string partitioner;
+  std::string boundingVolume;
+  std::string prune;
+
+  int    numFaces;
+  double buildTime;
+  int    depth;
+  int    numNodes;
+  int    numLeaves;
+  double avgPrimitivesPerLeaf;
+  int    maxPrimitivesPerLeaf;
+  double sahCost;
+  size_t treeMemoryEstimate;
+  size_t linearMemoryEstimate;
+
+  int    numQueries;
+  double meanLatency;
+  double p50Latency;
+  double p90Latency;
+  double p99Latency;
+  double maxLatency;
+  double avgRegularNodes;
+  double avgLeafNodes;
+  double avgBoundingVolumes;
+  double avgPrimitives;
+  double maxDifference;
+};
+
+// Tree statistics computed from the flattened tree, which has the same topology and bounding volumes as the original tree.
+struct TreeStatistics {
+  int    depth;
+  int    numNodes;
+  int    numLeaves;
+  double avgPrimitivesPerLeaf;
+  int    maxPrimitivesPerLeaf;
+  double sahCost;
+  size_t treeMemoryEstimate;
+  size_t linearMemoryEstimate;
+};
+
+template <class BV>
+TreeStatistics getTreeStatistics(const BVH::LinearBVHT<T, face, BV>& a_linearBVH) {
+  using Node       = BVH::NodeT<T, face, BV>;
+  using LinearNode = BVH::LinearNodeT<T, BV>;
+
+  const auto& nodes = a_linearBVH.getLinearNodes();
+
+  TreeStatistics stats;
+  stats.depth                = a_linearBVH.getDepth();
+  stats.numNodes             = nodes.size();
+  stats.numLeaves            = 0;
+  stats.maxPrimitivesPerLeaf = 0;
+  stats.sahCost              = 0.0;
+
+  const double rootArea = nodes[0].getBoundingVolume().getArea();
+
+  for (const auto& node : nodes){
+    const double relativeArea = node.getBoundingVolume().getArea()/rootArea;
+
+    if(node.isLeaf()){
+      stats.numLeaves++;
+      stats.maxPrimitivesPerLeaf = std::max(stats.maxPrimitivesPerLeaf, int(node.getNumPrimitives()));
+      stats.sahCost += relativeArea*node.getNumPrimitives()*intersectionCost;
+    }
+    else{
+      stats.sahCost += relativeArea*traversalCost;
+    }
+  }
+
+  const size_t numPrimitives = a_linearBVH.getPrimitives().size();
+
+  stats.avgPrimitivesPerLeaf = 1.0*numPrimitives/stats.numLeaves;
+
+  // These are estimates from the object sizes, not measured allocations. They ignore allocator overhead and unused vector capacity.
+  // Each node is allocated through std::make_shared, which adds a control block of two reference counts. Only leaves store
+  // primitives.
+  stats.treeMemoryEstimate   = stats.numNodes*(sizeof(Node) + 2*sizeof(long)) + numPrimitives*sizeof(std::shared_ptr<const face>);
+  stats.linearMemoryEstimate = stats.numNodes*sizeof(LinearNode) + numPrimitives*sizeof(std::shared_ptr<const face>);
+
+  return stats;
+}
+
+// Time all queries with one prune function and fill in the query part of the record.
+template <class Prune>
+void timeQueries(Record& a_record, const std::vector<Vec3>& a_points, const std::vector<T>& a_reference, const Prune& a_prune) {
+  std::vector<double> latencies(a_points.size());
+
+  BVH::QueryStats stats;
+
+  double maxDifference = 0.0;
+
+  for (size_t i = 0; i < a_points.size(); i++){
+    const auto tStart = Clock::now();
+    const T dist      = a_prune(a_points[i], stats);
+    const auto tEnd   = Clock::now();
+
+    latencies[i]  = std::chrono::duration<double>(tEnd - tStart).count();
+    maxDifference = std::max(maxDifference, double(std::abs(dist - a_reference[i])));
+  }
+
+  const double numQueries = a_points.size();
+
+  a_record.numQueries         = a_points.size();
+  a_record.avgRegularNodes    = stats.regularNodes/numQueries;
+  a_record.avgLeafNodes       = stats.leafNodes/numQueries;
+  a_record.avgBoundingVolumes = stats.boundingVolumes/numQueries;
+  a_record.avgPrimitives      = stats.primitives/numQueries;
+  a_record.maxDifference      = maxDifference;
+
+  double sum = 0.0;
+  for (const auto& l : latencies){
+    sum += l;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+
+  auto percentile = [&latencies](const double a_p){
+    const int index = std::min(latencies.size() - 1, size_t(a_p*latencies.size()));
+    return latencies[index];
+  };
+
+  a_record.meanLatency = sum/numQueries;
+  a_record.p50Latency  = percentile(0.50);
+  a_record.p90Latency  = percentile(0.90);
+  a_record.p99Latency  = percentile(0.99);
+  a_record.maxLatency  = latencies.back();
+}
+
+// Builders for runConfiguration.
+template <class BV>
+std::function<void(BVH::NodeT<T, face, BV>&)> sortAndPartition(const BVH::PartitionFunctionT<face>& a_partitioner) {
+  return [a_partitioner](BVH::NodeT<T, face, BV>& a_root){
+    a_root.topDownSortAndPartitionPrimitives(dcel::defaultStopFunction<T, BV>, a_partitioner, dcel::defaultBVConstructor<T, BV>);
+  };
+}
+
+template <class BV>
+std::function<void(BVH::NodeT<T, face, BV>&)> binnedSAH(const int a_primitivesPerLeaf) {
+  return [a_primitivesPerLeaf](BVH::NodeT<T, face, BV>& a_root){
+    a_root.topDownBinnedSAH(dcel::defaultPrimitiveBoundsFunction<T>, dcel::defaultBVConstructor<T, BV>, a_primitivesPerLeaf);
+  };
+}
+
+// Build a tree and time all prune functions on it. The flattened tree, the triangle packets and the snapshot are made from the
+// same tree, so they report the same traversal statistics as linearPruneOrdered2. Their build time also includes the time to
+// flatten the tree and to build the packets, while the snapshot build time is the time to load (map and validate) the snapshot.
+template <class BV>
+void runConfiguration(std::vector<Record>&                                 a_records,
+		      const std::string&                                   a_meshName,
+		      const std::shared_ptr<mesh>&                         a_mesh,
+		      const std::string&                                   a_builderName,
+		      const std::function<void(BVH::NodeT<T, face, BV>&)>& a_builder,
+		      const std::string&                                   a_boundingVolumeName,
+		      const std::vector<Vec3>&                             a_points) {
+  using Node     = BVH::NodeT<T, face, BV>;
+  using Packets  = dcel::TrianglePacketBVHT<T, BV>;
+  using Snapshot = dcel::BVHSnapshotT<T, BV>;
+
+  const auto tStart = Clock::now();
+  auto root = std::make_shared<Node>(a_mesh->getFaces());
+  a_builder(*root);
+  const auto tBuild = Clock::now();
+  const auto linearBVH = root->flattenTree();
+  const auto tFlatten = Clock::now();
+  const Packets packets(linearBVH);
+  const auto tPackets = Clock::now();
+
+  const std::string snapshotFile = "benchmark.snapshot";
+
+  Snapshot::write(snapshotFile, *linearBVH, 0, 0);
+
+  Snapshot snapshot;
+
+  const auto tLoadStart = Clock::now();
+  const bool loaded     = snapshot.load(snapshotFile, 0, 0);
+  const auto tLoadEnd   = Clock::now();
+
+  const auto treeStats = getTreeStatistics(*linearBVH);
+
+  // Reference distances. Other prune functions are compared against these.
+  std::vector<T> reference(a_points.size());
+  for (size_t i = 0; i < a_points.size(); i++){
+    reference[i] = linearBVH->pruneOrdered2(a_points[i]);
+  }
+
+  auto seconds = [](const Clock::time_point& a_start, const Clock::time_point& a_end){
+    return std::chrono::duration<double>(a_end - a_start).count();
+  };
+
+  Record record;
+  record.mesh                 = a_meshName;
+  record.partitioner          = a_builderName;
+  record.boundingVolume       = a_boundingVolumeName;
+  record.numFaces             = a_mesh->getFaces().size();
+  record.depth                = treeStats.depth;
+  record.numNodes             = treeStats.numNodes;
+  record.numLeaves            = treeStats.numLeaves;
+  record.avgPrimitivesPerLeaf = treeStats.avgPrimitivesPerLeaf;
+  record.maxPrimitivesPerLeaf = treeStats.maxPrimitivesPerLeaf;
+  record.sahCost              = treeStats.sahCost;
+  record.treeMemoryEstimate   = treeStats.treeMemoryEstimate;
+  record.linearMemoryEstimate = treeStats.linearMemoryEstimate;
+
+  using PruneFunction = std::function<T(const Vec3&, BVH::QueryStats&)>;
+
+  struct Prune {
+    std::string   name;
+    double        buildTime;
+    PruneFunction prune;
+  };
+
+  const double buildTime   = seconds(tStart, tBuild);
+  const double linearTime  = seconds(tStart, tFlatten);
+  const double packetsTime = seconds(tStart, tPackets);
+  const double loadTime    = seconds(tLoadStart, tLoadEnd);
+
+  std::vector<Prune> pruneFunctions = {
+    {"pruneOrdered",        buildTime,   [&root](const Vec3& x, BVH::QueryStats& s){ return root->pruneOrdered(x, s); }},
+    {"pruneOrdered2",       buildTime,   [&root](const Vec3& x, BVH::QueryStats& s){ return root->pruneOrdered2(x, s); }},
+    {"pruneUnordered",      buildTime,   [&root](const Vec3& x, BVH::QueryStats& s){ return root->pruneUnordered(x, s); }},
+    {"pruneUnordered2",     buildTime,   [&root](const Vec3& x, BVH::QueryStats& s){ return root->pruneUnordered2(x, s); }},
+    {"prunePriorityQueue",  buildTime,   [&root](const Vec3& x, BVH::QueryStats& s){ return root->prunePriorityQueue(x, s); }},
+    {"prunePriorityQueue2", buildTime,   [&root](const Vec3& x, BVH::QueryStats& s){ return root->prunePriorityQueue2(x, s); }},
+    {"linearPruneOrdered2", linearTime,  [&linearBVH](const Vec3& x, BVH::QueryStats& s){ return linearBVH->pruneOrdered2(x, s); }},
+    {"packetPruneOrdered2", packetsTime, [&packets](const Vec3& x, BVH::QueryStats& s){ return packets.pruneOrdered2(x, s); }}
+  };
+
+  if(loaded){
+    pruneFunctions.push_back({"snapshotPruneOrdered2", loadTime, [&snapshot](const Vec3& x, BVH::QueryStats& s){ return snapshot.pruneOrdered2(x, s); }});
+  }
+
+  for (const auto& prune : pruneFunctions){
+    record.prune     = prune.name;
+    record.buildTime = prune.buildTime;
+
+    timeQueries(record, a_points, reference, prune.prune);
+
+    a_records.emplace_back(record);
+
+    std::cerr << "  " << a_builderName << " / " << a_boundingVolumeName << " / " << prune.name
+	      << ": mean latency = " << record.meanLatency << " s\n";
+  }
+
+  std::remove(snapshotFile.c_str());
+}
+
+// Compare a narrow-band signed distance field with the exact distance at random points near the surface. The points are scattered
+// around random vertices so that most of them are in the band. Returns false if the error bound is violated.
+bool checkNarrowBandSDF(const std::shared_ptr<mesh>& a_mesh, const Vec3& a_lo, const Vec3& a_hi, const int a_numPoints) {
+  using AABB = BoundingVolumes::AABBT<T>;
+
+  auto root = std::make_shared<BVH::NodeT<T, face, AABB> >(a_mesh->getFaces());
+  root->topDownBinnedSAH(dcel::defaultPrimitiveBoundsFunction<T>, dcel::defaultBVConstructor<T, AABB>);
+
+  const auto linearBVH = root->flattenTree();
+
+  const T spacing    = (a_hi - a_lo).length()/100;
+  const T bandWidth  = 2*spacing;
+  const T errorBound = 0.05*spacing;
+
+  auto distanceFunction = [&linearBVH](const Vec3& a_point){
+    return linearBVH->pruneOrdered2(a_point);
+  };
+
+  dcel::NarrowBandSDFT<T> sdf(distanceFunction, a_lo, a_hi, spacing, bandWidth, errorBound);
+
+  const auto& vertices = a_mesh->getVertices();
+
+  auto rng   = std::mt19937_64(1);
+  auto udist = std::uniform_real_distribution<T>(-1.0, 1.0);
+  auto vdist = std::uniform_int_distribution<size_t>(0, vertices.size() - 1);
+
+  double maxError = 0.0;
+
+  for (int i = 0; i < a_numPoints; i++){
+    Vec3 p = vertices[vdist(rng)]->getPosition();
+    for (int dir = 0; dir < 3; dir++){
+      p[dir] += bandWidth*udist(rng);
+    }
+
+    const T exact = linearBVH->pruneOrdered2(p);
+
+    if(std::abs(exact) <= bandWidth){
+      maxError = std::max(maxError, double(std::abs(sdf.value(p) - exact)));
+    }
+  }
+
+  const bool ok = maxError <= errorBound;
+
+  std::cerr << "  NarrowBandSDFT: max error = " << maxError/errorBound << " times the error bound" << (ok ? "\n" : " - FAILED\n");
+
+  return ok;
+}
+
+// Sorted list of PLY files in a directory.
+std::vector<std::string> getMeshFiles(const std::string& a_directory) {
+  std::vector<std::string> files;
+
+  DIR* dir = opendir(a_directory.c_str());
+
+  if(dir != nullptr){
+    while(const dirent* entry = readdir(dir)){
+      const std::string name = entry->d_name;
+
+      if(name.size() > 4 && name.substr(name.size() - 4) == ".ply"){
+	files.emplace_back(name);
+      }
+    }
+
+    closedir(dir);
+  }
+
+  std::sort(files.begin(), files.end());
+
+  return files;
+}
+
+void writeCSV(std::ostream& a_out, const std::vector<Record>& a_records) {
+  a_out << "mesh,partitioner,bounding_volume,prune,num_faces,build_time,depth,num_nodes,num_leaves,avg_primitives_per_leaf,"
+	<< "max_primitives_per_leaf,sah_cost,tree_memory_estimate,linear_memory_estimate,num_queries,mean_latency,p50_latency,p90_latency,p99_latency,"
+	<< "max_latency,avg_regular_nodes,avg_leaf_nodes,avg_bounding_volumes,avg_primitives,max_difference\n";
+
+  for (const auto& r : a_records){
+    a_out << r.mesh << "," << r.partitioner << "," << r.boundingVolume << "," << r.prune << ","
+	  << r.numFaces << "," << r.buildTime << "," << r.depth << "," << r.numNodes << "," << r.numLeaves << ","
+	  << r.avgPrimitivesPerLeaf << "," << r.maxPrimitivesPerLeaf << "," << r.sahCost << ","
+	  << r.treeMemoryEstimate << "," << r.linearMemoryEstimate << "," << r.numQueries << ","
+	  << r.meanLatency << "," << r.p50Latency << "," << r.p90Latency << "," << r.p99Latency << "," << r.maxLatency << ","
+	  << r.avgRegularNodes << "," << r.avgLeafNodes << "," << r.avgBoundingVolumes << "," << r.avgPrimitives << ","
+	  << r.maxDifference << "\n";
+  }
+}
+
+void writeJSON(std::ostream& a_out, const std::vector<Record>& a_records) {
+  a_out << "[\n";
+
+  for (size_t i = 0; i < a_records.size(); i++){
+    const auto& r = a_records[i];
+
+    a_out << "  {"
+	  << "\"mesh\": \"" << r.mesh << "\", "
+	  << "\"partitioner\": \"" << r.partitioner << "\", "
+	  << "\"bounding_volume\": \"" << r.boundingVolume << "\", "
+	  << "\"prune\": \"" << r.prune << "\", "
+	  << "\"num_faces\": " << r.numFaces << ", "
+	  << "\"build_time\": " << r.buildTime << ", "
+	  << "\"depth\": " << r.depth << ", "
+	  << "\"num_nodes\": " << r.numNodes << ", "
+	  << "\"num_leaves\": " << r.numLeaves << ", "
+	  << "\"avg_primitives_per_leaf\": " << r.avgPrimitivesPerLeaf << ", "
+	  << "\"max_primitives_per_leaf\": " << r.maxPrimitivesPerLeaf << ", "
+	  << "\"sah_cost\": " << r.sahCost << ", "
+	  << "\"tree_memory_estimate\": " << r.treeMemoryEstimate << ", "
+	  << "\"linear_memory_estimate\": " << r.linearMemoryEstimate << ", "
+	  << "\"num_queries\": " << r.numQueries << ", "
+	  << "\"mean_latency\": " << r.meanLatency << ", "
+	  << "\"p50_latency\": " << r.p50Latency << ", "
+	  << "\"p90_latency\": " << r.p90Latency << ", "
+	  << "\"p99_latency\": " << r.p99Latency << ", "
+	  << "\"max_latency\": " << r.maxLatency << ", "
+	  << "\"avg_regular_nodes\": " << r.avgRegularNodes << ", "
+	  << "\"avg_leaf_nodes\": " << r.avgLeafNodes << ", "
+	  << "\"avg_bounding_volumes\": " << r.avgBoundingVolumes << ", "
+	  << "\"avg_primitives\": " << r.avgPrimitives << ", "
+	  << "\"max_difference\": " << r.maxDifference
+	  << "}" << (i + 1 < a_records.size() ? ",\n" : "\n");
+  }
+
+  a_out << "]\n";
+}
+
+int main(int argc, char* argv[]) {
+  const std::string directory = "./ply_inputs";
+
+  int numQueries          = 2000;
+  std::string format      = "json";
+  std::string outputFile  = "";
+  std::string meshFilter  = "";
+
+  for (int i = 1; i < argc; i++){
+    const std::string arg = argv[i];
+
+    if(i + 1 < argc && arg == "--queries"){
+      numQueries = std::atoi(argv[++i]);
+    }
+    else if(i + 1 < argc && arg == "--format"){
+      format = argv[++i];
+    }
+    else if(i + 1 < argc && arg == "--output"){
+      outputFile = argv[++i];
+    }
+    else if(i + 1 < argc && arg == "--mesh"){
+      meshFilter = argv[++i];
+    }
+    else{
+      std::cerr << "Usage: " << argv[0] << " [--queries N] [--format json|csv] [--output file] [--mesh name]\n";
+      return 1;
+    }
+  }
+
+  std::vector<Record> records;
+
+  bool sdfOK = true;
+
+  for (const auto& meshName : getMeshFiles(directory)){
+    if(meshName.find(meshFilter) == std::string::npos) continue;
+
+    std::cerr << "Mesh " << meshName << "\n";
+
+    auto m = std::make_shared<mesh>();
+    dcel::parser::PLY<T>::read(*m, directory + "/" + meshName);
+    m->reconcile();
+
+    if(m->getFaces().empty()) continue;
+
+    // Random query points in the bounding box of the mesh, grown by 50% in each direction.
+    Vec3 lo = Vec3::max();
+    Vec3 hi = Vec3::min();
+    for (const auto& v : m->getVertices()){
+      lo = min(lo, v->getPosition());
+      hi = max(hi, v->getPosition());
+    }
+
+    const Vec3 center = T(0.5)*(lo + hi);
+    const Vec3 delta  = T(1.0)*(hi - lo);
+
+    auto rng  = std::mt19937_64(0);
+    auto udist = std::uniform_real_distribution<T>(-1.0, 1.0);
+
+    std::vector<Vec3> points(numQueries);
+    for (auto& p : points){
+      p = center;
+      for (int dir = 0; dir < 3; dir++){
+	p[dir] += delta[dir]*udist(rng);
+      }
+    }
+
+    using AABB   = BoundingVolumes::AABBT<T>;
+    using Sphere = BoundingVolumes::BoundingSphereT<T>;
+
+    runConfiguration<AABB>  (records, meshName, m, "defaultPartitionFunction", sortAndPartition<AABB>  (dcel::defaultPartitionFunction<T>),        "AABB",   points);
+    runConfiguration<Sphere>(records, meshName, m, "defaultPartitionFunction", sortAndPartition<Sphere>(dcel::defaultPartitionFunction<T>),        "Sphere", points);
+    runConfiguration<AABB>  (records, meshName, m, "partitionMinimumOverlap",  sortAndPartition<AABB>  (dcel::partitionMinimumOverlap<T, AABB>),   "AABB",   points);
+    runConfiguration<Sphere>(records, meshName, m, "partitionMinimumOverlap",  sortAndPartition<Sphere>(dcel::partitionMinimumOverlap<T, Sphere>), "Sphere", points);
+    runConfiguration<AABB>  (records, meshName, m, "partitionSAH",             sortAndPartition<AABB>  (dcel::partitionSAH<T, AABB>),              "AABB",   points);
+    runConfiguration<Sphere>(records, meshName, m, "partitionSAH",             sortAndPartition<Sphere>(dcel::partitionSAH<T, Sphere>),            "Sphere", points);
+    runConfiguration<AABB>  (records, meshName, m, "binnedSAH",                binnedSAH<AABB>  (1),                                                "AABB",   points);
+    runConfiguration<Sphere>(records, meshName, m, "binnedSAH",                binnedSAH<Sphere>(1),                                                "Sphere", points);
+    runConfiguration<AABB>  (records, meshName, m, "binnedSAH8",               binnedSAH<AABB>  (8),                                                "AABB",   points);
+    runConfiguration<Sphere>(records, meshName, m, "binnedSAH8",               binnedSAH<Sphere>(8),                                                "Sphere", points);
+
+    sdfOK = checkNarrowBandSDF(m, lo, hi, numQueries) && sdfOK;
+  }
+
+  std::ofstream file;
+  if(!outputFile.empty()){
+    file.open(outputFile);
+  }
+
+  std::ostream& out = outputFile.empty() ? std::cout : file;
+
+  if(format == "csv"){
+    writeCSV(out, records);
+  }
+  else{
+    writeJSON(out, records);
+  }
+
+  return sdfOK ? 0 : 1;
+}
@@ -4,10 +4,16 @@
 #include "dcel_mesh.H"
 #include "dcel_parser.H"
 #include "dcel_BVH.H"
+#include "dcel_packet.H"
+#include "dcel_snapshot.H"
+#include "dcel_sdf.H"
+#include "dcel_compact.H"
 #include "BoundingVolumes.H"
 #include "BVH.H"
+#include "RigidTransform.H"
 
 #include <chrono>
+#include <iostream>
 #include <random>
 
 // Specifies precision for BVH/DCEL magic, and which bounding volume to use. 
@@ -17,7 +23,7 @@ using mesh      = dcel::meshT<T>;
 using BoundVol  = BoundingVolumes::AABBT<T>;
 
 // Input file to read. 
-const std::string fname = "./ply_inputs/armadillo.ply";
+const std::string fname = "./ply_inputs/bunny.ply";
 
 int main() {
 
@@ -32,6 +38,102 @@ int main() {
 					  dcel::partitionSAH<T, BoundVol>,
 					  dcel::defaultBVConstructor<T, BoundVol>);
 
+  // Alternatively, use the binned SAH builder which is much faster for large meshes and builds subtrees in parallel. 
+  // root->topDownBinnedSAH(dcel::defaultPrimitiveBoundsFunction<T>, dcel::defaultBVConstructor<T, BoundVol>);
+
   // To get a (signed) distance you will do (other BVH pruning functions are available but this is the fastest one). 
   const T dist = root->pruneOrdered2(Vec3T<T>::one());
+
+  std::cout << "Distance from BVH                 = " << dist << "\n";
+
+  // The tree can also be flattened into a compact, pointer-free representation which gives the same answer but is faster to traverse. 
+  const auto linearRoot = root->flattenTree();
+  const T linearDist    = linearRoot->pruneOrdered2(Vec3T<T>::one());
+
+  std::cout << "Distance from flattened BVH       = " << linearDist << "\n";
+
+  // For triangle meshes the leaves can be evaluated with SIMD triangle packets. This pays off when the leaves hold several
+  // triangles, e.g. with a stop function that allows bigger leaves. topDownBinnedSAH only makes bigger leaves where its cost model
+  // favours them. Compile with -mavx2 or -march=native to get the AVX kernel. 
+  dcel::TrianglePacketBVHT<T, BoundVol> packetRoot(linearRoot);
+  const T packetDist = packetRoot.pruneOrdered2(Vec3T<T>::one());
+
+  std::cout << "Distance from triangle packets    = " << packetDist << "\n";
+
+  // The flattened tree and the mesh data it needs can be written to a snapshot file. Later runs can map the snapshot instead of
+  // parsing the file and rebuilding the tree. load() fails if the source file or the builder settings have changed. 
+  using Snapshot = dcel::BVHSnapshotT<T, BoundVol>;
+
+  const uint64_t sourceHash   = Snapshot::hashFile(fname);
+  const uint64_t settingsHash = Snapshot::hashBuildSettings("topDownSortAndPartitionPrimitives/partitionSAH", dcel::primitivesPerLeafNode);
+
+  Snapshot::write("example.snapshot", *linearRoot, sourceHash, settingsHash);
+
+  Snapshot snapshot;
+  if(snapshot.load("example.snapshot", sourceHash, settingsHash)){
+    const T snapshotDist = snapshot.pruneOrdered2(Vec3T<T>::one());
+
+    std::cout << "Distance from snapshot            = " << snapshotDist << "\n";
+  }
+
+  // Repeated queries in the same region can be cached in a narrow-band signed distance field which interpolates exact distances
+  // stored on a sparse grid. Here with grid spacing 0.01, a band width of 0.05 and an interpolation error bound of 0.001. This
+  // is also how dcel_if can be given a cache. 
+  Vec3T<T> lo = Vec3T<T>::max();
+  Vec3T<T> hi = Vec3T<T>::min();
+  for (const auto& v : m->getVertices()){
+    lo = min(lo, v->getPosition());
+    hi = max(hi, v->getPosition());
+  }
+
+  auto distanceFunction = [linearRoot](const Vec3T<T>& a_point){
+    return linearRoot->pruneOrdered2(a_point);
+  };
+  
+  dcel::NarrowBandSDFT<T> sdf(distanceFunction, lo, hi, 0.01, 0.05, 0.001);
+  const T cachedDist = sdf.value(Vec3T<T>::one());
+
+  std::cout << "Distance from narrow-band SDF     = " << cachedDist << "\n";
+
+  // Large meshes can be stored in a compact mesh, which keeps vertices, half edges, and faces in contiguous arrays with index
+  // links. Elements are accessed through lightweight handles, and the face handles work as BVH primitives. The primitive list
+  // does not own the faces, so the mesh must outlive the tree. 
+  using compactFace = dcel::compactFaceT<T>;
+
+  dcel::compactMeshT<T> compactMesh;
+  dcel::parser::PLY<T>::read(compactMesh, fname);
+  compactMesh.reconcile();
+
+  auto compactRoot = std::make_shared<BVH::NodeT<T, compactFace, BoundVol> >(compactMesh.getFacePrimitives());
+  compactRoot->topDownBinnedSAH(dcel::defaultPrimitiveBoundsFunction<T, compactFace>, dcel::defaultBVConstructor<T, BoundVol, compactFace>);
+
+  const T compactDist = compactRoot->pruneOrdered2(Vec3T<T>::one());
+
+  std::cout << "Distance from compact mesh BVH    = " << compactDist << "\n";
+
+  // When the mesh deforms, move the vertices and refit the tree instead of rebuilding it. Subtrees whose surface area heuristic
+  // cost has grown by more than 50% since they were built are rebuilt, here with the same builder that built the tree. A flattened
+  // tree can be refitted with LinearBVHT::bottomUpRefit(dcel::defaultPrimitiveBVConstructor<T, BoundVol, compactFace>), while
+  // triangle packets and snapshots must be made again after a refit. 
+  std::vector<Vec3T<T> > positions;
+  for (unsigned int i = 0; i < compactMesh.getNumVertices(); i++){
+    positions.emplace_back(compactMesh.getVertex(i).getPosition() + Vec3T<T>(0.01, 0.0, 0.0));
+  }
+
+  compactMesh.setVertexPositions(positions);
+  compactMesh.reconcile();
+
+  auto compactBuilder = [](BVH::NodeT<T, compactFace, BoundVol>& a_node){
+    a_node.topDownBinnedSAH(dcel::defaultPrimitiveBoundsFunction<T, compactFace>, dcel::defaultBVConstructor<T, BoundVol, compactFace>);
+  };
+
+  compactRoot->refitAndRebuild(dcel::defaultBVConstructor<T, BoundVol, compactFace>, compactBuilder, 1.5);
+
+  // Rigidly moving bodies do not need to touch the tree at all. The query points are transformed into the body frame. 
+  BVH::RigidBodyT<T> body(distanceFunction);
+  body.setTransform(BVH::RigidTransformT<T>(Vec3T<T>(0., 0., 1.), 0.1, Vec3T<T>(0.5, 0., 0.)));
+
+  const T rigidDist = body.value(Vec3T<T>::one());
+
+  std::cout << "Distance to the moved rigid body  = " << rigidDist << "\n";
 }
@@ -0,0 +1,194 @@
+#include "dcel_vertex.H"
+#include "dcel_edge.H"
+#include "dcel_face.H"
+#include "dcel_mesh.H"
+#include "dcel_parser.H"
+#include "dcel_compact.H"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <cstdint>
+
+// Specifies precision for DCEL magic.
+using T         = float;
+using mesh      = dcel::meshT<T>;
+using compact   = dcel::compactMeshT<T>;
+
+// Input files to read.
+const std::vector<std::string> fnames = {"./ply_inputs/bunny.ply",
+					 "./ply_inputs/dodecahedron.ply",
+					 "./ply_inputs/hind.ply",
+					 "./ply_inputs/mug.ply",
+					 "./ply_inputs/octahedron.ply",
+					 "./ply_inputs/orion.ply",
+					 "./ply_inputs/porsche.ply",
+					 "./ply_inputs/sphere.ply",
+					 "./ply_inputs/tetrahedron.ply",
+					 "./ply_inputs/turbine.ply"};
+
+// Each file is read this many times and the fastest read is reported.
+const int numRepetitions = 3;
+
+// Write a mesh as a binary PLY file in the byte order of this machine. Only positions and vertex indices are written.
+void writeBinary(const mesh& a_mesh, const std::string a_filename) {
+  const uint16_t one          = 1;
+  const bool     hostIsLittle = *reinterpret_cast<const unsigned char*>(&one) == 1;
+
+  const auto& vertices = a_mesh.getVertices();
+  const auto& faces    = a_mesh.getFaces();
+
+  std::map<const dcel::vertexT<T>*, int> vertexIndices;
+  for (unsigned int i = 0; i < vertices.size(); i++){
+    vertexIndices.emplace(vertices[i].get(), i);
+  }
+
+  std::ofstream out(a_filename, std::ios::binary);
+
+  out << "ply\n"
+      << (hostIsLittle ? "format binary_little_endian 1.0\n" : "format binary_big_endian 1.0\n")
+      << "element vertex " << vertices.size() << "\n"
+      << "property float x\n"
+      << "property float y\n"
+      << "property float z\n"
+      << "element face " << faces.size() << "\n"
+      << "property list uchar int vertex_indices\n"
+      << "end_header\n";
+
+  for (const auto& v : vertices){
+    for (int dir = 0; dir < 3; dir++){
+      const float x = v->getPosition()[dir];
+      out.write(reinterpret_cast<const char*>(&x), sizeof(float));
+    }
+  }
+
+  for (const auto& f : faces){
+    const auto faceVertices = f->gatherVertices();
+
+    const unsigned char numVertices = faceVertices.size();
+    out.write(reinterpret_cast<const char*>(&numVertices), sizeof(unsigned char));
+
+    for (const auto& v : faceVertices){
+      const int index = vertexIndices.at(v.get());
+      out.write(reinterpret_cast<const char*>(&index), sizeof(int));
+    }
+  }
+}
+
+// Check that two meshes have the same vertices, faces, and pair edges.
+bool equalMeshes(const mesh& a_mesh1, const mesh& a_mesh2) {
+  const auto& vertices1 = a_mesh1.getVertices();
+  const auto& vertices2 = a_mesh2.getVertices();
+  const auto& edges1    = a_mesh1.getEdges();
+  const auto& edges2    = a_mesh2.getEdges();
+
+  bool equal = vertices1.size() == vertices2.size() && edges1.size() == edges2.size() && a_mesh1.getFaces().size() == a_mesh2.getFaces().size();
+
+  for (unsigned int i = 0; i < vertices1.size() && equal; i++){
+    equal = equal && (vertices1[i]->getPosition() - vertices2[i]->getPosition()).length() == 0.0;
+  }
+
+  for (unsigned int i = 0; i < edges1.size() && equal; i++){
+    const auto& pair1 = edges1[i]->getPairEdge();
+    const auto& pair2 = edges2[i]->getPairEdge();
+
+    equal = equal && (pair1 == nullptr) == (pair2 == nullptr);
+    if(pair1 != nullptr && pair2 != nullptr){
+      equal = equal && (pair1->getVertex()->getPosition() - pair2->getVertex()->getPosition()).length() == 0.0;
+    }
+  }
+
+  return equal;
+}
+
+// Check that a compact mesh has the same vertices, faces, and pair edges as a mesh. 
+bool equalMeshes(const mesh& a_mesh, const compact& a_compact) {
+  const auto& vertices = a_mesh.getVertices();
+  const auto& edges    = a_mesh.getEdges();
+
+  bool equal = vertices.size() == a_compact.getNumVertices() && edges.size() == a_compact.getNumEdges() && a_mesh.getFaces().size() == a_compact.getNumFaces();
+
+  for (size_t i = 0; i < vertices.size() && equal; i++){
+    equal = equal && (vertices[i]->getPosition() - a_compact.getVertex(i).getPosition()).length() == 0.0;
+  }
+
+  // Both readers store the half edges of each face contiguously, so the edges have the same order. 
+  for (size_t i = 0; i < edges.size() && equal; i++){
+    const auto& pair1 = edges[i]->getPairEdge();
+    const auto  pair2 = a_compact.getEdge(i).getPairEdge();
+
+    equal = equal && (pair1 == nullptr) == !pair2.isValid();
+    if(pair1 != nullptr && pair2.isValid()){
+      equal = equal && (pair1->getVertex()->getPosition() - pair2.getVertex().getPosition()).length() == 0.0;
+    }
+  }
+
+  return equal;
+}
+
+double timeReadCompact(compact& a_mesh, const std::string a_filename) {
+  double minTime = std::numeric_limits<double>::infinity();
+
+  for (int irep = 0; irep < numRepetitions; irep++){
+    const auto tStart = std::chrono::high_resolution_clock::now();
+    dcel::parser::PLY<T>::read(a_mesh, a_filename);
+    const auto tEnd   = std::chrono::high_resolution_clock::now();
+
+    minTime = std::min(minTime, std::chrono::duration<double>(tEnd - tStart).count());
+  }
+
+  return minTime;
+}
+
+template <class Reader>
+double timeRead(mesh& a_mesh, const std::string a_filename, const Reader& a_reader) {
+  double minTime = std::numeric_limits<double>::infinity();
+
+  for (int irep = 0; irep < numRepetitions; irep++){
+    a_mesh = mesh();
+
+    const auto tStart = std::chrono::high_resolution_clock::now();
+    a_reader(a_mesh, a_filename);
+    const auto tEnd   = std::chrono::high_resolution_clock::now();
+
+    minTime = std::min(minTime, std::chrono::duration<double>(tEnd - tStart).count());
+  }
+
+  return minTime;
+}
+
+// readASCII is the original stream reader. The other readers are timed against it and must give the same mesh. 
+int main() {
+  std::cout << "File                             Faces   readASCII [s]   read (ascii) [s]   readBinary [s]   read (compact) [s]   Equal\n";
+  std::cout << "======================================================================================================================\n";
+
+  for (const auto& fname : fnames){
+    mesh streamMesh;
+    mesh mappedMesh;
+    mesh binaryMesh;
+    compact compactMesh;
+
+    const std::string binaryName = fname + ".binary";
+
+    const double streamTime = timeRead(streamMesh, fname, dcel::parser::PLY<T>::readASCII);
+    const double mappedTime  = timeRead(mappedMesh, fname, [](mesh& m, const std::string f){ dcel::parser::PLY<T>::read(m, f); });
+    const double compactTime = timeReadCompact(compactMesh, fname);
+
+    writeBinary(mappedMesh, binaryName);
+
+    const double binaryTime = timeRead(binaryMesh, binaryName, dcel::parser::PLY<T>::readBinary);
+
+    std::remove(binaryName.c_str());
+
+    const bool equal = equalMeshes(streamMesh, mappedMesh) && equalMeshes(mappedMesh, binaryMesh) && equalMeshes(mappedMesh, compactMesh);
+
+    std::printf("%-30s %8d %15.4f %18.4f %16.4f %20.4f   %s\n",
+		fname.c_str(),
+		int(mappedMesh.getFaces().size()),
+		streamTime,
+		mappedTime,
+		binaryTime,
+		compactTime,
+		equal ? "yes" : "no");
+  }
+}
@@ -19,7 +19,7 @@ using BoundVol  = BoundingVolumes::AABBT<T>;
 constexpr int DIM = 3;
 
 // Input file to read. 
-const std::string fname = "./ply_inputs/armadillo.ply";
+const std::string fname = "./ply_inputs/bunny.ply";
 
 // How to draw random positions
 const int numRanMeshQueries = 32;
@@ -52,39 +52,34 @@ int main() {
 
   // Draw a couple of random positions and time the output when using the BVH.
   T totalDistance = 0.0;
-  T reguCalls     = 0.0;
-  T leafCalls     = 0.0;
   auto totalTime  = std::chrono::duration<T> (0.);
+
+  // Counts the work done in the BVH queries. Prune functions called without a stats object do no counting. 
+  BVH::QueryStats stats;
   
   for (int ipos = 0; ipos < numRanBVHQueries; ipos++){
-    BVH::reguCalls = 0;
-    BVH::leafCalls = 0;
-    
     Vec3T<T> randomPosition = lo;
     for (int dir = 0; dir < DIM; dir++){
       randomPosition[dir] += delta[dir]*udist01(rng);
     }
     
     auto tStart = std::chrono::high_resolution_clock::now();
-    totalDistance += root->pruneOrdered2(randomPosition);
+    totalDistance += root->pruneOrdered2(randomPosition, stats);
     auto tEnd = std::chrono::high_resolution_clock::now();
     
     totalTime += std::chrono::duration_cast<std::chrono::duration<T> >(tEnd -tStart);
-
-    reguCalls += 1.0*BVH::reguCalls;
-    leafCalls += 1.0*BVH::leafCalls;
   }
 
   std::cout << "\n";
   std::cout << "BVH queries:\n";
   std::cout << "============\n";
   std::cout << "Number of point queries = " << numRanBVHQueries                   << "\n"
-	    << "Regu node queries       = " << reguCalls/numRanBVHQueries         << "\n"
-    	    << "Leaf node queries       = " << leafCalls/numRanBVHQueries         << "\n"
+	    << "Regu node queries       = " << 1.0*stats.regularNodes/numRanBVHQueries << "\n"
+    	    << "Leaf node queries       = " << 1.0*stats.leafNodes/numRanBVHQueries    << "\n"
     	    << "Total distance          = " << totalDistance                      << "\n"
 	    << "Total time              = " << totalTime.count()                  << "\n"
 	    << "Avg. time per query     = " << totalTime.count()/numRanBVHQueries << "\n"
-	    << "Avg. time per tri       = " << totalTime.count()/(numRanBVHQueries*numFaces) << "\n";
+	    << "Avg. time per tri       = " << totalTime.count()/(1.0*numRanBVHQueries*numFaces) << "\n";
 
 
   // Below here, we draw random positions and query the DCEL mesh structure directly. 
@@ -110,6 +105,6 @@ int main() {
 	    << "Total distance          = " << totalDistance                      << "\n"
 	    << "Total time              = " << totalTime.count()                   << "\n"
 	    << "Avg. time per query     = " << totalTime.count()/numRanMeshQueries << "\n"
-	    << "Avg. time per tri       = " << totalTime.count()/(numRanMeshQueries*numFaces) << "\n\n";
+	    << "Avg. time per tri       = " << totalTime.count()/(1.0*numRanMeshQueries*numFaces) << "\n\n";
 
 }